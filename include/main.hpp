@@ -1,6 +1,24 @@
 #ifndef MAIN_HPP
 #define MAIN_HPP
 
+// 编译配置
+// 显示缓冲页数：0为整帧缓冲（1KB），1/2为页缓冲（128B/256B），页缓冲模式按页循环绘制
+#ifndef DISPLAY_PAGES
+#define DISPLAY_PAGES 0
+#endif
+// EEPROM模拟区大小，RAM中保留同样大小的镜像，骑行记录容量随之变化
+#ifndef EEPROM_SIZE
+#define EEPROM_SIZE 4096
+#endif
+// 界面最短刷新间隔：ms，0为每次循环都刷新；浸泡测试按虚拟时间计，取1分钟以跳过绝大部分绘制
+#ifndef FRAME_INTERVAL
+#ifdef SOAK_TEST
+#define FRAME_INTERVAL 60000
+#else
+#define FRAME_INTERVAL 0
+#endif
+#endif
+
 // 屏幕引脚定义
 #define LCD_SCK 2
 #define LCD_SDA 3
@@ -20,6 +38,9 @@
 #define HALL_SENSOR_PIN 27
 #define HALL_CONNECT_PIN 26
 
+// 测试脉冲输出引脚（基准测试时跳线连接到HALL_SENSOR_PIN）
+#define TEST_PULSE_PIN 28
+
 // 蜂鸣器引脚定义
 #define BUZZER 16
 
@@ -28,19 +49,64 @@
 #define WS2812_PIN 24
 #define WS2812_NUM 1
 
+// 时钟及输入输出（浸泡测试编译时为虚拟时钟、模拟输入，不驱动输出）
+uint32_t clockUs();
+uint32_t clockMs();
+int readPin(uint8_t pin);
+void writePin(uint8_t pin, int value);
+void setLedColor(uint32_t color);
+uint16_t readHallCounter();
+
 // 中断服务函数
 void hallSensorISR(uint gpio, uint32_t events);
 
+// 脉冲间隔预滤波
+void filterPulseInterval(uint32_t interval);
+void resetPulseFilter();
+
+// 超速判定
+void updateOverspeed(uint32_t interval, uint8_t slot);
+void setOverspeedAlert(bool alert);
+
+// 多磁铁间距学习
+void advanceMagnetSlot(uint32_t interval);
+void learnMagnetSpacing();
+void resetMagnetSpacing();
+
+// 霍尔信号质量统计
+uint8_t widthPercentile(uint8_t percent);
+void updateHallStats();
+
 // 按键扫描函数
 int scanButtons();
 
 // EEPROM操作
 void saveConfig();
 void loadConfig();
+uint32_t commitConfig();
+
+// 骑行检查点
+void checkpointRide(unsigned long now);
+
+// 骑行记录
+void beginRide(uint32_t now);
+void updateRideRecord();
+
+// 速度计算
+float calculateSpeed(uint32_t interval, uint8_t slot);
 
 // 时间格式化
 void formatTime(unsigned long milliseconds, char* buffer, size_t bufferSize, bool isTotal);
 
+// 设置项读写
+float readSettingRaw(uint8_t index);
+int32_t getSettingValue(uint8_t index);
+void setSettingValue(uint8_t index, int32_t value);
+void formatSetting(uint8_t index, char* buffer, size_t bufferSize);
+void applyConfig();
+void confirmEditedSetting();
+void restoreEditedSetting();
+
 // 参数编辑函数 
 void modifyValue(int8_t delta);
 
@@ -49,6 +115,11 @@ void drawMeasuring();
 void drawSettingMenu();
 void drawStats();
 void drawAbout();
+void drawGraph();
+void drawHistory();
+
+// 速度曲线采样
+void pushGraphSample(float speed);
 
 // 按键处理
 void handleSettingMenu(int btn);
@@ -66,8 +137,30 @@ float applyWeightedAvg(float speed);
 // 一阶低通滤波
 float applyLowPass(float speed);
 // 卡尔曼滤波
-float applyKalman(float speed);
+float applyKalman(float speed, bool measured);
+// 卡尔曼噪声自适应
+void adaptKalmanNoise(float innovation, float pPredict, float k);
 // 重置滤波器
 void resetAllFilters();
 
+#ifdef PERF_BENCH
+// 性能基准测试
+void runBenchmarks();
+bool runCheckpointPulseTest();
+#endif
+
+#ifdef SOAK_TEST
+// 加速时间浸泡测试
+void runSoakTest();
+float soakRecentMax();
+void soakStep(uint32_t us);
+void soakRunUntil(uint64_t targetUs, uint32_t tickUs);
+void soakIdle(uint32_t ms);
+void soakPress(int8_t button);
+void soakPulse(uint64_t atUs, uint32_t periodUs);
+void soakRide(uint32_t durationMs);
+void soakStop(uint32_t ms);
+uint32_t soakRandom(uint32_t range);
+#endif
+
 #endif
\ No newline at end of file